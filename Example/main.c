@@ -43,17 +43,26 @@ typedef struct someStruct {
 	size_t count;
 	uint8_t pages[4097];
 	uint8_t field6;
+	uint32_t typedField;
+	uint64_t typedDoubled;
+	uint32_t bulkFields[64];
+	uint64_t bulkSum;
+	uint8_t hotPadding[4096]; // instrumented variable must not share page with trapped variables
+	uint64_t hotCounter;
 } someStruct;
 
 // user functions
 
+void typedExample(uint32_t* field, uint64_t* doubled); // typed.cpp
+
 void* pagesAlloc(size_t size, bool isGuard) {
 	void* result;
 	if (isGuard) {
-		result = VirtualAlloc(NULL, size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE|PAGE_GUARD); // imaginary pages
+		result = VirtualAlloc(NULL, size, MEM_COMMIT|MEM_RESERVE|MEM_WRITE_WATCH, PAGE_READWRITE|PAGE_GUARD); // imaginary pages, write watch for RM_TRACKING_POLLING
 	} else {
 		result = VirtualAlloc(NULL, size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE); // real pages
 	}
+	return result;
 }
 
 void pagesFree(void* pointer) {
@@ -70,6 +79,23 @@ void pagesProtectUnlock(void* pointer, size_t size) {
 	VirtualProtect(pointer, size, PAGE_READWRITE, &oldProtect);
 }
 
+void pagesCollectDirty(void* pointer, size_t pagesCount, bool* dirtyPages) {
+	void** addresses = malloc(sizeof(void*)*pagesCount);
+	ULONG_PTR addressesCount = pagesCount;
+	ULONG granularity;
+	if (addresses != NULL && GetWriteWatch(WRITE_WATCH_FLAG_RESET, pointer, pagesCount*4096, addresses, &addressesCount, &granularity) == 0) {
+		memset(dirtyPages, 0, sizeof(bool)*pagesCount);
+		for (ULONG_PTR i=0; i<addressesCount; i++) {
+			dirtyPages[((size_t)addresses[i]-(size_t)pointer)/4096] = true;
+		}
+	} else { // all pages are compared with snapshot
+		for (size_t i=0; i<pagesCount; i++) {
+			dirtyPages[i] = true;
+		}
+	}
+	free(addresses);
+}
+
 void enableTrap(void* userData) {
 	PEXCEPTION_POINTERS ExceptionInfo = (PEXCEPTION_POINTERS)userData;
 	ExceptionInfo->ContextRecord->EFlags |= 0x00000100;
@@ -120,6 +146,16 @@ void computedField6(void* bufForReturnValue, void* imPointer) {
 	*field6 = _someStruct->pages[0];
 }
 
+void computedBulkSum(void* bufForReturnValue, void* imPointer) {
+	uint64_t* bulkSum = (uint64_t*)bufForReturnValue;
+	someStruct* _someStruct = (someStruct*)imPointer;
+	uint64_t sum = 0;
+	for (size_t i=0; i<64; i++) {
+		sum += _someStruct->bulkFields[i];
+	}
+	*bulkSum = sum;
+}
+
 void triggerCallback1(void* value, void* oldValue, void* imPointer) {
 	uint32_t* val = (uint32_t*)value;
 	uint32_t* oldVal = (uint32_t*)oldValue;
@@ -155,6 +191,12 @@ void triggerCallback5(void* value, void* oldValue, void* imPointer) {
 	printf("[trigger5] watch value (field6): %hhu, oldValue (field6): %hhu\n", *val, *oldVal);
 }
 
+void triggerCallback6(void* value, void* oldValue, void* imPointer) {
+	uint64_t* val = (uint64_t*)value;
+	uint64_t* oldVal = (uint64_t*)oldValue;
+	printf("[trigger6] watch value (bulkSum): %llu, oldValue (bulkSum): %llu\n", *val, *oldVal);
+}
+
 LONG NTAPI imExeption(PEXCEPTION_POINTERS ExceptionInfo) {
 	if (ExceptionInfo->ExceptionRecord->ExceptionCode == EXCEPTION_GUARD_PAGE) {
 		if (ExceptionInfo->ExceptionRecord->ExceptionInformation[0] == 0 || ExceptionInfo->ExceptionRecord->ExceptionInformation[0] == 1) { // 0 = read, 1 = write, 8 = DEP
@@ -178,6 +220,10 @@ int main() {
 	if (initReactivity(RM_MODE_NONLAZY, pagesAlloc, pagesFree, pagesProtectLock, pagesProtectUnlock, enableTrap) == RM_STATUS_SUCCESS) {
 		void* exHandler = AddVectoredExceptionHandler(1, imExeption);
 		someStruct* someStruct = reactiveAlloc(sizeof(struct someStruct));
+		// change log in shared memory, other processes can map "ReactiveMemoryChangeLog" and read it without syscalls
+		HANDLE changeLogMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, 65536, L"ReactiveMemoryChangeLog");
+		changeLog* log = MapViewOfFile(changeLogMapping, FILE_MAP_ALL_ACCESS, 0, 0, 65536);
+		attachChangeLog(log, 65536, RM_CHANGELOG_OVERFLOW_DROP);
 	
 		ref(&someStruct->page1, sizeof(someStruct->page1));
 		ref(&someStruct->page2, sizeof(someStruct->page2));
@@ -225,10 +271,12 @@ int main() {
 		someStruct->elem2.listEntry.next =  &someStruct->elem3;
 	
 		watch(&someStruct->field3, triggerCallback1);
+		watchDelivery(&someStruct->field3, RM_DELIVERY_ON_FLUSH, 0); // one trigger for both changes of field1 below
 		watch(&someStruct->field4, triggerCallback2);
 
 		someStruct->field1 = 77;
 		someStruct->field1 = 79;
+		flush();
 		someStruct->field4.field3 = 5;
 	
 		printf("field1: %u, field2.field2: %u, field3: %u\n", someStruct->field1, someStruct->field2.field2, someStruct->field3);
@@ -238,6 +286,68 @@ int main() {
 		// write 2 bytes on pages boundary by one instruction into two variables
 		*(uint16_t*)(void*)((size_t)&someStruct->page1+(4096-1)) = 0x1234;
 
+		typedExample(&someStruct->typedField, &someStruct->typedDoubled);
+
+		// bulk registration, all variables from one allocation, depends of computed variables are enumerated once
+		variableDescriptor descriptors[65];
+		for (size_t i=0; i<64; i++) {
+			descriptors[i] = (variableDescriptor){ .pointer = &someStruct->bulkFields[i], .size = sizeof(someStruct->bulkFields[i]), .kind = RM_VARIABLE_REF, .callback = NULL, .triggerCallback = NULL };
+		}
+		descriptors[64] = (variableDescriptor){ .pointer = &someStruct->bulkSum, .size = sizeof(someStruct->bulkSum), .kind = RM_VARIABLE_COMPUTED, .callback = computedBulkSum, .triggerCallback = triggerCallback6 };
+		LARGE_INTEGER frequency, start, end;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&start);
+		RM_STATUS bulkStatus = registerMany(descriptors, 65);
+		QueryPerformanceCounter(&end);
+		printf("registerMany status: %d, %.2f us\n", bulkStatus, (double)(end.QuadPart-start.QuadPart)*1e6/frequency.QuadPart);
+		someStruct->bulkFields[10] = 5;
+		someStruct->bulkFields[63] = 7;
+		printf("bulkSum: %llu\n", someStruct->bulkSum);
+		descriptors[0].size = 0;
+		printf("registerMany with empty variable status: %d\n", registerMany(descriptors, 1));
+
+		// instrumented variable accessed without exceptions vs trapped variable
+		instrumentedRef* hotCounter = refInstrumented(&someStruct->hotCounter, sizeof(someStruct->hotCounter));
+		QueryPerformanceCounter(&start);
+		for (size_t i=0; i<1000000; i++) {
+			RM_STORE(hotCounter, uint64_t, RM_LOAD(hotCounter, uint64_t)+1);
+		}
+		QueryPerformanceCounter(&end);
+		printf("instrumented access: %.2f ns\n", (double)(end.QuadPart-start.QuadPart)*1e9/frequency.QuadPart/2000000);
+		flush();
+		QueryPerformanceCounter(&start);
+		for (size_t i=0; i<1000; i++) {
+			someStruct->page2[0] = (uint8_t)i;
+		}
+		QueryPerformanceCounter(&end);
+		printf("trapped write: %.2f ns\n", (double)(end.QuadPart-start.QuadPart)*1e9/frequency.QuadPart/1000);
+
+		// writes without exceptions, compared with snapshot on flush
+		if (setWriteTracking(RM_TRACKING_POLLING, pagesCollectDirty) == RM_STATUS_SUCCESS) {
+			someStruct->field4.field3 = 6;
+			someStruct->field4.field3 = 7;
+			flush(); // one trigger for both writes
+			setWriteTracking(RM_TRACKING_EXCEPTIONS, NULL);
+		}
+
+		uint32_t field1Id;
+		variableId(&someStruct->field1, &field1Id);
+		changeLogRecord* record;
+		while ((record = changeLogNext(log)) != NULL) {
+			if (record->type == RM_CHANGELOG_RECORD_COMMIT) {
+				printf("[changelog] commit batch %llu\n", record->offset);
+			} else if (record->variableId == field1Id) {
+				printf("[changelog] field1 offset %llu length %llu\n", record->offset, record->length);
+			} else {
+				printf("[changelog] variable %u offset %llu length %llu\n", record->variableId, record->offset, record->length);
+			}
+			changeLogRelease(log, record);
+		}
+		printf("[changelog] dropped batches: %llu\n", loadShared64(&log->overflowCount));
+		detachChangeLog();
+		UnmapViewOfFile(log);
+		CloseHandle(changeLogMapping);
+
 		reactiveFree(someStruct);
 
 		RemoveVectoredExceptionHandler(exHandler);
@@ -0,0 +1,14 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "../ReactiveMemory/reactivity.hpp"
+
+// typed front end, pointers must be located in reactive memory, variables are unregistered on return
+extern "C" void typedExample(uint32_t* field, uint64_t* doubled) {
+	rm::Ref typedField(field);
+	rm::Computed typedDoubled(doubled, [field]() { return (uint64_t)*field * 2; });
+	auto watcher = rm::watch(typedDoubled, [](const uint64_t& value, const uint64_t& oldValue) {
+		printf("[typed] watch value (doubled): %llu, oldValue (doubled): %llu\n", value, oldValue);
+	});
+	typedField = 21;
+	printf("[typed] field: %u, doubled: %llu\n", (const uint32_t&)typedField, (const uint64_t&)typedDoubled);
+}
\ No newline at end of file
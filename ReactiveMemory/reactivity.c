@@ -1,12 +1,21 @@
 #include "reactivity.h"
 
+#define RM_WHEEL_SLOTS 256 // timer wheel slots, one slot for every millisecond
+
 typedef struct variableEntry {
 	struct variable* variable;
+	struct variableEntry* link; // paired entry in opposite edge list (depends <-> observers), NULL for page dependents
 	struct variableEntry* prev;
 	struct variableEntry* next;
 } variableEntry;
 
+typedef struct variableList {
+	variableEntry* tail;
+	variableEntry* head;
+} variableList;
+
 typedef struct variable {
+	uint32_t id; // unique for every registration, used in change log
 	void* value;
 	void* bufValue; // buffer for value from computed callback
 	void* oldValue;
@@ -14,22 +23,38 @@ typedef struct variable {
 	bool isComputed;
 	void (*callback)(void* bufForReturnValue, void* imPointer); // pointer to compute callback
 	void (*triggerCallback)(void* value, void* oldValue, void* imPointer); // pointer to trigger callback
-	struct { // variables which depends on this variable
-		variableEntry* tail;
-		variableEntry* head;
-	} observers;
-	struct { // variables on which this variable depends, valid only for computed
-		variableEntry* tail;
-		variableEntry* head;
-	} depends;
-	struct variable* next; // TODO double-linked list
+	void (*contextCallback)(void* bufForReturnValue, void* imPointer, void* context); // used instead of callback if not NULL
+	void (*contextTriggerCallback)(void* value, void* oldValue, void* imPointer, void* context); // used instead of triggerCallback if not NULL
+	void* callbackContext;
+	void* triggerContext;
+	variableList observers; // variables which depends on this variable
+	variableList depends; // variables on which this variable depends, valid only for computed
+	variableEntry* pageEntries; // array of entries linked to dependents of every page of this variable
+	size_t pageEntriesCapacity;
+	size_t pageIndex; // index of first page of this variable
+	size_t pagesCount;
+	bool isChunkVariable; // allocated in chunk by registerMany, freed with chunk
+	bool isChunkPageEntries;
+	instrumentedRef* handle; // not NULL for variables accessed by RM_LOAD/RM_STORE
+	RM_DELIVERY delivery;
+	uint64_t interval; // milliseconds for RM_DELIVERY_DEBOUNCE/RM_DELIVERY_THROTTLE
+	uint64_t deadline; // time of scheduled trigger delivery
+	uint64_t nextDelivery; // earliest time of next delivery for RM_DELIVERY_THROTTLE
+	void* pendingOldValue; // old value of first change of coalesced changes
+	bool isScheduled;
+	variableEntry timerEntry; // linked to timer wheel slot or to flushTriggers
+	struct variable* prev;
+	struct variable* next;
 } variable;
 
+typedef struct variableChunk { // followed by array of variable and array of variableEntry for pages
+	struct variableChunk* next;
+} variableChunk;
+
 typedef struct mmPage {
-	struct { // variables which whole or part located on this page
-		variableEntry* tail;
-		variableEntry* head;
-	} dependents;
+	variableList dependents; // variables which whole or part located on this page
+	size_t instrumentedCount; // count of instrumented variables on this page
+	bool isPlain; // page has no variables or has instrumented variables, it is not guarded
 } mmPage;
 
 typedef struct mmBlock {
@@ -42,6 +67,8 @@ typedef struct mmBlock {
 	size_t size;
 	mmPage* pages; // array of mmPage
 	size_t pagesCount;
+	size_t plainPagesCount;
+	bool* dirtyPages; // written pages reported by pagesCollectDirty, only for RM_TRACKING_POLLING
 } mmBlock;
 
 typedef struct engineState {
@@ -51,8 +78,10 @@ typedef struct engineState {
 	variable* registerComputed;
 	variable** changedVariables; // array of variable*
 	size_t changedVariablesCount;
+	bool isPropagation; // callbacks of changed variables are running
 	mmBlock* reactiveMem; // TODO chain of blocks
 	RM_MODE mode;
+	RM_TRACKING tracking;
 	struct {
 		variable* tail;
 		variable* head;
@@ -62,16 +91,34 @@ typedef struct engineState {
 	void (*pagesProtectLock)(void* pointer, size_t size);
 	void (*pagesProtectUnlock)(void* pointer, size_t size);
 	void (*enableTrap)(void* userData);
+	void (*pagesCollectDirty)(void* pointer, size_t pagesCount, bool* dirtyPages);
+	variable* freeVariables; // removed variables for reuse
+	variableChunk* chunks;
+	variableEntry* freeEntries; // removed list entries for reuse
+	uint32_t nextVariableId;
+	changeLog* log; // NULL if change log not attached
+	RM_CHANGELOG_OVERFLOW logOverflow;
+	uint64_t logPosition; // write position of current batch, published to head on commit
+	uint64_t logSequence; // sequence number of current batch
+	bool logBatchDropped;
+	uint64_t now; // milliseconds, from last tick
+	uint64_t wheelTime; // all wheel slots up to this time processed
+	variableList wheel[RM_WHEEL_SLOTS]; // variables with scheduled trigger delivery
+	variableList flushTriggers; // variables with trigger delivery on flush
 } engineState;
 
 // engine data
 
+bool dependsEnumeration = false; // state.registerComputed != NULL, for RM_LOAD without engine call
+
 engineState state = {
 	.registerComputed = NULL,
 	.changedVariables = NULL,
 	.changedVariablesCount = 0,
+	.isPropagation = false,
 	.reactiveMem = NULL,
 	.mode = RM_MODE_LAZY,
+	.tracking = RM_TRACKING_EXCEPTIONS,
 	.variables = {
 		.tail = NULL,
 		.head = NULL
@@ -80,23 +127,259 @@ engineState state = {
 	.pagesFree = NULL,
 	.pagesProtectLock = NULL,
 	.pagesProtectUnlock = NULL,
-	.enableTrap = NULL
+	.enableTrap = NULL,
+	.pagesCollectDirty = NULL,
+	.freeVariables = NULL,
+	.chunks = NULL,
+	.freeEntries = NULL,
+	.nextVariableId = 0,
+	.log = NULL,
+	.logOverflow = RM_CHANGELOG_OVERFLOW_DROP,
+	.logPosition = 0,
+	.logSequence = 0,
+	.logBatchDropped = false,
+	.now = 0,
+	.wheelTime = 0,
+	.wheel = { { .tail = NULL, .head = NULL } }, // all slots empty
+	.flushTriggers = {
+		.tail = NULL,
+		.head = NULL
+	}
 };
 
 // engine functions
 
-variable* getVariable(void* pointer) {
-	variable* result = NULL;
-	variable* variableToTest = state.variables.head;
-	while (variableToTest!=NULL) {
-		// strict inequality in second case for last byte
-		if (((size_t)variableToTest->value <= (size_t)pointer) && ((size_t)pointer < (size_t)variableToTest->value+variableToTest->size)) {
-			result = variableToTest;
-			break;
+// returns NULL if error occured
+variableEntry* allocVariableEntry() {
+	variableEntry* entry = state.freeEntries;
+	if (entry != NULL) {
+		state.freeEntries = entry->next;
+	} else {
+		entry = memAlloc(sizeof(variableEntry));
+	}
+	return entry;
+}
+
+void releaseVariableEntry(variableEntry* entry) {
+	entry->next = state.freeEntries;
+	state.freeEntries = entry;
+}
+
+void appendEntry(variableList* list, variableEntry* entry) {
+	entry->prev = list->tail;
+	entry->next = NULL;
+	if (list->head == NULL) {
+		list->head = entry;
+	} else {
+		list->tail->next = entry;
+	}
+	list->tail = entry;
+}
+
+void removeEntry(variableList* list, variableEntry* entry) {
+	if (entry->prev != NULL) {
+		entry->prev->next = entry->next;
+	} else { // this is first element
+		list->head = entry->next;
+	}
+	if (entry->next != NULL) {
+		entry->next->prev = entry->prev;
+	} else { // this is last element
+		list->tail = entry->prev;
+	}
+}
+
+// page is guarded only if it holds variables and none of them is instrumented
+void updatePageGuard(size_t pageIndex) {
+	mmPage* page = &state.reactiveMem->pages[pageIndex];
+	bool isPlain = page->dependents.head == NULL || page->instrumentedCount > 0;
+	if (isPlain != page->isPlain) {
+		void* pageAddress = (void*)((size_t)state.reactiveMem->imPointer+pageIndex*4096);
+		page->isPlain = isPlain;
+		if (isPlain) {
+			state.reactiveMem->plainPagesCount++;
+			state.pagesProtectUnlock(pageAddress, 4096);
+		} else {
+			state.reactiveMem->plainPagesCount--;
+			if (state.tracking == RM_TRACKING_EXCEPTIONS) {
+				state.pagesProtectLock(pageAddress, 4096);
+			}
+		}
+	}
+}
+
+// lock pages which hold reactive variables, plain pages stay unguarded
+void lockReactivePages() {
+	mmBlock* block = state.reactiveMem;
+	if (block->plainPagesCount == 0) {
+		state.pagesProtectLock(block->imPointer, block->size);
+	} else {
+		size_t runStart = 0;
+		for (size_t i=0; i<=block->pagesCount; i++) {
+			if (i == block->pagesCount || block->pages[i].isPlain) {
+				if (i > runStart) {
+					size_t runSize = (i-runStart)*4096;
+					if (runStart*4096 + runSize > block->size) { // last page can be partial
+						runSize = block->size - runStart*4096;
+					}
+					state.pagesProtectLock((void*)((size_t)block->imPointer+runStart*4096), runSize);
+				}
+				runStart = i+1;
+			}
+		}
+	}
+}
+
+// returns NULL if batch dropped
+changeLogRecord* changeLogReserve(uint64_t recordSize) {
+	changeLogRecord* record = NULL;
+	changeLog* log = state.log;
+	if (!state.logBatchDropped) {
+		uint64_t position = state.logPosition&(log->capacity-1);
+		uint64_t padding = 0;
+		if (log->capacity-position < recordSize) { // record must be contiguous, skip to start of ring
+			padding = log->capacity-position;
+		}
+		uint64_t end = state.logPosition+padding+recordSize;
+		if (end-loadShared64(&log->tail) > log->capacity) {
+			// consumer can free enough space only by reading published batches
+			if (state.logOverflow == RM_CHANGELOG_OVERFLOW_WAIT && end-loadShared64(&log->head) <= log->capacity) {
+				while (end-loadShared64(&log->tail) > log->capacity) {}
+				RM_BARRIER(); // write only after consumer released space
+			} else {
+				state.logBatchDropped = true;
+			}
+		}
+		if (!state.logBatchDropped) {
+			if (padding >= sizeof(changeLogRecord)) {
+				changeLogRecord* paddingRecord = changeLogRecordAt(log, position);
+				paddingRecord->type = RM_CHANGELOG_RECORD_PADDING;
+				paddingRecord->variableId = 0;
+				paddingRecord->offset = 0;
+				paddingRecord->length = padding-sizeof(changeLogRecord);
+			}
+			record = changeLogRecordAt(log, (state.logPosition+padding)&(log->capacity-1));
+			state.logPosition = end;
+		}
+	}
+	return record;
+}
+
+// append changed bytes span of variable to current batch
+void changeLogAppend(variable* var, void* oldValue, void* newValue) {
+	uint8_t* oldBytes = (uint8_t*)oldValue;
+	uint8_t* newBytes = (uint8_t*)newValue;
+	size_t first = 0;
+	while (first<var->size && oldBytes[first]==newBytes[first]) {
+		first++;
+	}
+	if (first<var->size) {
+		size_t last = var->size-1;
+		while (oldBytes[last]==newBytes[last]) {
+			last--;
+		}
+		uint64_t length = last-first+1;
+		changeLogRecord* record = changeLogReserve(sizeof(changeLogRecord)+((length+7)&(~(uint64_t)7)));
+		if (record != NULL) {
+			record->type = RM_CHANGELOG_RECORD_CHANGE;
+			record->variableId = var->id;
+			record->offset = (size_t)var->value-(size_t)state.reactiveMem->imPointer+first;
+			record->length = length;
+			memCopy((void*)(record+1), &newBytes[first], length);
+		}
+	}
+}
+
+// close current batch and publish it to consumers
+void changeLogCommit() {
+	if (state.logPosition != loadShared64(&state.log->head) || state.logBatchDropped) {
+		changeLogRecord* record = changeLogReserve(sizeof(changeLogRecord));
+		if (record != NULL) {
+			record->type = RM_CHANGELOG_RECORD_COMMIT;
+			record->variableId = 0;
+			record->offset = state.logSequence;
+			record->length = 0;
+		}
+		if (state.logBatchDropped) {
+			state.logPosition = loadShared64(&state.log->head);
+			state.logBatchDropped = false;
+			storeShared64(&state.log->overflowCount, loadShared64(&state.log->overflowCount)+1);
+		} else {
+			RM_BARRIER(); // publish head only after records
+			storeShared64(&state.log->head, state.logPosition);
+		}
+		state.logSequence++; // gap in sequence of commits for dropped batch
+	}
+}
+
+void callCompute(variable* var) {
+	if (var->contextCallback != NULL) {
+		var->contextCallback(var->bufValue, state.reactiveMem->imPointer, var->callbackContext);
+	} else {
+		var->callback(var->bufValue, state.reactiveMem->imPointer);
+	}
+}
+
+// call computed callback for #PF and enum depends for computed and observers for refs in #PF handler routine
+void enumerateDepends(variable* var) {
+	state.registerComputed = var;
+	dependsEnumeration = true;
+	callCompute(var);
+	state.registerComputed = NULL;
+	dependsEnumeration = false;
+}
+
+void callTrigger(variable* var, void* oldValue) {
+	if (var->contextTriggerCallback != NULL) {
+		var->contextTriggerCallback(var->value, oldValue, state.reactiveMem->imPointer, var->triggerContext);
+	} else if (var->triggerCallback != NULL) {
+		var->triggerCallback(var->value, oldValue, state.reactiveMem->imPointer);
+	}
+}
+
+void scheduleTrigger(variable* var, uint64_t deadline) {
+	if (var->isScheduled) {
+		removeEntry(&state.wheel[var->deadline%RM_WHEEL_SLOTS], &var->timerEntry);
+	}
+	var->deadline = deadline;
+	var->isScheduled = true;
+	appendEntry(&state.wheel[deadline%RM_WHEEL_SLOTS], &var->timerEntry);
+}
+
+void unscheduleTrigger(variable* var) {
+	if (var->isScheduled) {
+		if (var->delivery == RM_DELIVERY_ON_FLUSH) {
+			removeEntry(&state.flushTriggers, &var->timerEntry);
+		} else {
+			removeEntry(&state.wheel[var->deadline%RM_WHEEL_SLOTS], &var->timerEntry);
+		}
+		var->isScheduled = false;
+	}
+}
+
+// call trigger now or coalesce change with pending ones by delivery policy of variable
+void deliverTrigger(variable* var) {
+	if (var->delivery == RM_DELIVERY_IMMEDIATE) {
+		callTrigger(var, var->oldValue);
+	} else if (var->triggerCallback != NULL || var->contextTriggerCallback != NULL) {
+		bool isFirstChange = !var->isScheduled;
+		if (isFirstChange) {
+			memCopy(var->pendingOldValue, var->oldValue, var->size);
+		}
+		if (var->delivery == RM_DELIVERY_DEBOUNCE) {
+			scheduleTrigger(var, state.now+var->interval); // postpone on every change
+		} else if (var->delivery == RM_DELIVERY_THROTTLE) {
+			if (isFirstChange && state.now >= var->nextDelivery) {
+				var->nextDelivery = state.now+var->interval;
+				callTrigger(var, var->pendingOldValue);
+			} else if (isFirstChange) {
+				scheduleTrigger(var, var->nextDelivery);
+			}
+		} else if (isFirstChange) { // RM_DELIVERY_ON_FLUSH
+			var->isScheduled = true;
+			appendEntry(&state.flushTriggers, &var->timerEntry);
 		}
-		variableToTest = variableToTest->next;
 	}
-	return result;
 }
 
 inline variable* getVariableFromPage(void* pointer) {
@@ -118,6 +401,130 @@ inline variable* getVariableFromPage(void* pointer) {
 	return result;
 }
 
+void enqueueChange(variable* var) {
+	state.changedVariables = memRealloc(state.changedVariables, (state.changedVariablesCount+1+1)*sizeof(variable*)); // TODO check to memRealloc return NULL
+	state.changedVariables[state.changedVariablesCount] = var;
+	state.changedVariablesCount++;
+	state.changedVariables[state.changedVariablesCount] = NULL;
+}
+
+// for register computed variable (will be call multiple times for one computed variable)
+void recordDepends(variable* var) {
+	if (!var->isComputed) {
+		// check for variable already added to depends list
+		variableEntry* testDependsEntry = state.registerComputed->depends.head;
+		bool variableFound = false;
+		while (testDependsEntry != NULL) {
+			if (testDependsEntry->variable == var) {
+				variableFound = true;
+				break;
+			}
+			testDependsEntry = testDependsEntry->next;
+		}
+		if (!variableFound) {
+			// for register computed variable (will be call multiple times for one computed variable)
+			// 1. get list of static variables on which computed variable depends (by call computed callback)
+			// 2. add computed observer to every static variable
+			variableEntry* dependsEntry = allocVariableEntry(); // TODO check to allocVariableEntry return NULL
+			variableEntry* observersEntry = allocVariableEntry(); // TODO check to allocVariableEntry return NULL
+			dependsEntry->variable = var;
+			dependsEntry->link = observersEntry;
+			appendEntry(&state.registerComputed->depends, dependsEntry);
+			observersEntry->variable = state.registerComputed;
+			observersEntry->link = dependsEntry;
+			appendEntry(&var->observers, observersEntry);
+		}
+	}
+}
+
+// run callbacks of changed variables and their observers, pages must be locked
+void propagateChanges() {
+	if (state.changedVariablesCount>0) {
+		// detach batch, changes enqueued by callbacks (RM_STORE) go to new queue and can't overwrite unprocessed entries
+		variable** changedVariables = state.changedVariables;
+		size_t changedVariablesCount = state.changedVariablesCount;
+		state.changedVariables = NULL;
+		state.changedVariablesCount = 0;
+		bool isOuterPropagation = state.isPropagation; // triggers can write refs and start nested propagation
+		state.isPropagation = true;
+		for (size_t i=0; i<changedVariablesCount; i++) {
+			variable* changedVariable = changedVariables[i];
+			if (changedVariable->handle != NULL) {
+				changedVariable->handle->isPending = false; // next RM_STORE enqueue it again
+			}
+			if (!changedVariable->isComputed) {
+				variableEntry* compEntryToFree = NULL;
+				variableEntry* compEntry = changedVariable->observers.head;
+				changedVariable->observers.head = NULL;
+				changedVariable->observers.tail = NULL;
+				bool isGuarded = changedVariable->handle == NULL; // pages of instrumented variables are plain and must stay unguarded
+				if (state.log != NULL) {
+					if (isGuarded) {
+						state.pagesProtectUnlock(changedVariable->value, changedVariable->size);
+					}
+					changeLogAppend(changedVariable, changedVariable->oldValue, changedVariable->value);
+					if (isGuarded) {
+						state.pagesProtectLock(changedVariable->value, changedVariable->size);
+					}
+				}
+				deliverTrigger(changedVariable);
+				if (state.tracking == RM_TRACKING_POLLING && isGuarded) {
+					// snapshot for compare on next flush
+					state.pagesProtectUnlock(changedVariable->value, changedVariable->size);
+					memCopy(changedVariable->oldValue, changedVariable->value, changedVariable->size);
+					state.pagesProtectLock(changedVariable->value, changedVariable->size);
+				}
+				while (compEntry!=NULL) {
+					// save old value for computed variable
+					// TODO RM_MODE_LAZY
+					state.pagesProtectUnlock(compEntry->variable->value, compEntry->variable->size);
+					memCopy(compEntry->variable->oldValue, compEntry->variable->value, compEntry->variable->size);
+					state.pagesProtectLock(compEntry->variable->value, compEntry->variable->size);
+					// update computed variable depends
+					// free depends list
+					variableEntry* variableEntryToFree = NULL;
+					variableEntry* nextVariableEntry = compEntry->variable->depends.head;
+					while (nextVariableEntry!=NULL) {
+						variableEntryToFree = nextVariableEntry;
+						nextVariableEntry = nextVariableEntry->next;
+						// remove paired entry from depend variable observers list
+						// observers list of changed variable already detached and will be freed by this loop
+						if (variableEntryToFree->variable != changedVariable) {
+							removeEntry(&variableEntryToFree->variable->observers, variableEntryToFree->link);
+							releaseVariableEntry(variableEntryToFree->link);
+						}
+						releaseVariableEntry(variableEntryToFree);
+					}
+					compEntry->variable->depends.head = NULL;
+					compEntry->variable->depends.tail = NULL;
+					enumerateDepends(compEntry->variable);
+					if (state.log != NULL) {
+						changeLogAppend(compEntry->variable, compEntry->variable->oldValue, compEntry->variable->bufValue);
+					}
+					state.pagesProtectUnlock(compEntry->variable->value, compEntry->variable->size);
+					memCopy(compEntry->variable->value, compEntry->variable->bufValue, compEntry->variable->size);
+					state.pagesProtectLock(compEntry->variable->value, compEntry->variable->size);
+					deliverTrigger(compEntry->variable);
+					compEntryToFree = compEntry;
+					compEntry = compEntry->next;
+					releaseVariableEntry(compEntryToFree);
+				}
+			}
+		}
+		state.isPropagation = isOuterPropagation;
+		if (state.changedVariables == NULL) {
+			state.changedVariables = changedVariables; // nothing enqueued by callbacks, reuse buffer
+			state.changedVariables[0] = NULL;
+		} else {
+			memFree(changedVariables);
+		}
+	}
+	// exceptions from callbacks are part of batch of outer propagation
+	if (state.log != NULL && !state.isPropagation) {
+		changeLogCommit();
+	}
+}
+
 // if we run in kernel mode we can isolate reactive memory to kernel space to prevent write to it from user mode process
 void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void* pointer) {
 	if (exception == RM_EXCEPTION_PAGEFAULT) {
@@ -127,53 +534,10 @@ void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void
 				mtx_lock(&state.reactiveMem->mutex);
 			#endif
 			if (state.registerComputed != NULL) {
-				if (!realAddr->isComputed) {
-					// check for variable already added to depends list
-					variableEntry* testDependsEntry = state.registerComputed->depends.head;
-					bool variableFound = false;
-					while (testDependsEntry != NULL) {
-						if (testDependsEntry->variable == realAddr) {
-							variableFound = true;
-							break;
-						}
-						testDependsEntry = testDependsEntry->next;
-					}
-					if (!variableFound) {
-						// for register computed variable (will be call multiple times for one computed variable)
-						// 1. get list of static variables on which computed variable depends (by call computed callback)
-						// 2. add computed observer to every static variable
-						variableEntry* dependsEntry = memAlloc(sizeof(variableEntry)); // TODO check to memAlloc return NULL
-						dependsEntry->variable = realAddr;
-						dependsEntry->prev = NULL;
-						dependsEntry->next = NULL;
-						if (state.registerComputed->depends.head == NULL) {
-							state.registerComputed->depends.head = dependsEntry;
-							state.registerComputed->depends.tail = dependsEntry;
-						} else {
-							dependsEntry->prev = state.registerComputed->depends.tail;
-							state.registerComputed->depends.tail->next = dependsEntry;
-							state.registerComputed->depends.tail = dependsEntry;
-						}
-						variableEntry* observersEntry = memAlloc(sizeof(variableEntry)); // TODO check to memAlloc return NULL
-						observersEntry->variable = state.registerComputed;
-						observersEntry->prev = NULL;
-						observersEntry->next = NULL;
-						if (realAddr->observers.head == NULL) {
-							realAddr->observers.head = observersEntry;
-							realAddr->observers.tail = observersEntry;
-						} else {
-							observersEntry->prev = realAddr->observers.tail;
-							realAddr->observers.tail->next = observersEntry;
-							realAddr->observers.tail = observersEntry;
-						}
-					}
-				}
+				recordDepends(realAddr);
 			} else {
 				if (isWrite) {
-					state.changedVariables = memRealloc(state.changedVariables, (state.changedVariablesCount+1+1)*sizeof(variable*)); // TODO check to memRealloc return NULL
-					state.changedVariables[state.changedVariablesCount] = realAddr;
-					state.changedVariablesCount++;
-					state.changedVariables[state.changedVariablesCount] = NULL;
+					enqueueChange(realAddr);
 					// kernel unlock only accessed page, unlock all of them (for instructions which access to data on pages boundary (on two pages))
 					state.pagesProtectUnlock(realAddr->value, realAddr->size);
 					// save old value for ref variable
@@ -188,8 +552,8 @@ void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void
 						// 3. #PF -> unlock page 2
 						// 4. calc value of computed variable2 with access to variable from page 1
 						// 5. !missing #PF (page 1 unlocked)!
-						state.pagesProtectLock(state.reactiveMem->imPointer, state.reactiveMem->size);
-						realAddr->callback(realAddr->bufValue, state.reactiveMem->imPointer);
+						lockReactivePages();
+						callCompute(realAddr);
 						// unlock all pages (not only pages for accessed varible) for prevent bug:
 						// variable1 placed on page1, variable2 placed on page2
 						// 1. execute instruction which access to data on pages boundary (on two pages)
@@ -199,6 +563,9 @@ void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void
 						// 5. unlock pages of variable2 (page2)
 						// 6. !execute instruction again -> #PF (page1 locked)!
 						state.pagesProtectUnlock(state.reactiveMem->imPointer, state.reactiveMem->size);
+						if (state.log != NULL) {
+							changeLogAppend(realAddr, realAddr->value, realAddr->bufValue);
+						}
 						memCopy(realAddr->value, realAddr->bufValue, realAddr->size);
 					}
 				}
@@ -207,210 +574,614 @@ void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void
 		}
 	}
 	else if (exception == RM_EXCEPTION_DEBUG) {
-		state.pagesProtectLock(state.reactiveMem->imPointer, state.reactiveMem->size);
-		if (state.changedVariablesCount>0) {
-			size_t changedVariablesCount = state.changedVariablesCount;
-			state.changedVariablesCount = 0;
-			for (size_t i=0; i<changedVariablesCount; i++) {
-				variable* changedVariable = state.changedVariables[i];
-				if (!changedVariable->isComputed) {
-					variableEntry* compEntryToFree = NULL;
-					variableEntry* compEntry = changedVariable->observers.head;
-					changedVariable->observers.head = NULL;
-					changedVariable->observers.tail = NULL;
-					if (changedVariable->triggerCallback!=NULL) {
-						changedVariable->triggerCallback(changedVariable->value, changedVariable->oldValue, state.reactiveMem->imPointer);
-					}
-					while (compEntry!=NULL) {
-						// save old value for computed variable
-						// TODO RM_MODE_LAZY
-						state.pagesProtectUnlock(compEntry->variable->value, compEntry->variable->size);
-						memCopy(compEntry->variable->oldValue, compEntry->variable->value, compEntry->variable->size);
-						state.pagesProtectLock(compEntry->variable->value, compEntry->variable->size);
-						// update computed variable depends
-						// free depends list
-						variableEntry* variableEntryToFree = NULL;
-						variableEntry* nextVariableEntry = compEntry->variable->depends.head;
-						while (nextVariableEntry!=NULL) {
-							variableEntryToFree = nextVariableEntry;
-							nextVariableEntry = nextVariableEntry->next;
-							// find and remove it from depend variable observers list
-							variableEntry* observerNextVariableEntry = variableEntryToFree->variable->observers.head;
-							while (observerNextVariableEntry!=NULL) {
-								if (observerNextVariableEntry->variable == compEntry->variable) {
-									if (observerNextVariableEntry->prev!=NULL) {
-										observerNextVariableEntry->prev->next = observerNextVariableEntry->next;
-										if (observerNextVariableEntry->next==NULL) { // this is last element
-											variableEntryToFree->variable->observers.tail = observerNextVariableEntry->prev;
-										}
-									} else { // this is first element
-										if (observerNextVariableEntry->next!=NULL) {
-											variableEntryToFree->variable->observers.head = observerNextVariableEntry->next;
-										} else { // only one element
-											variableEntryToFree->variable->observers.head = NULL;
-											variableEntryToFree->variable->observers.tail = NULL;
-										}
-									}
-									if (observerNextVariableEntry->next!=NULL) {
-										observerNextVariableEntry->next->prev = observerNextVariableEntry->prev;
-									}
-									memFree(observerNextVariableEntry);
-									break;
-								}
-								observerNextVariableEntry = observerNextVariableEntry->next;
-							}
-							memFree(variableEntryToFree);
-						}
-						compEntry->variable->depends.head = NULL;
-						compEntry->variable->depends.tail = NULL;
-						state.registerComputed = compEntry->variable;
-						compEntry->variable->callback(compEntry->variable->bufValue, state.reactiveMem->imPointer);
-						state.registerComputed = NULL;
-						state.pagesProtectUnlock(compEntry->variable->value, compEntry->variable->size);
-						memCopy(compEntry->variable->value, compEntry->variable->bufValue, compEntry->variable->size);
-						state.pagesProtectLock(compEntry->variable->value, compEntry->variable->size);
-						if (compEntry->variable->triggerCallback!=NULL) {
-							compEntry->variable->triggerCallback(compEntry->variable->value, compEntry->variable->oldValue, state.reactiveMem->imPointer);
-						}
-						compEntryToFree = compEntry;
-						compEntry = compEntry->next;
-						memFree(compEntryToFree);
-					}
-				}
-			}
-		}
+		lockReactivePages();
+		propagateChanges();
 		#ifdef THREADSAFE
 			mtx_unlock(&state.reactiveMem->mutex);
 		#endif
 	}
 }
 
-// returns NULL if error occured
-variable* createVariable(void* pointer, size_t size) {
-	variable* oldTail = state.variables.tail;
-	bool allDependentsAllocationSuccess = true;
-	variable* var = memAlloc(sizeof(variable));
-	if (var != NULL) {
-		var->isComputed = false;
-		var->callback = NULL;
-		var->triggerCallback = NULL;
-		var->observers.head = NULL;
-		var->observers.tail = NULL;
-		var->depends.head = NULL;
-		var->depends.tail = NULL;
-		var->next = NULL;
-		size_t offset = (size_t)pointer - (size_t)state.reactiveMem->imPointer; // delta
-		var->bufValue = (void*)((size_t)state.reactiveMem->reBufPointer+offset);
-		var->oldValue = (void*)((size_t)state.reactiveMem->reOldPointer+offset);
-		var->value = pointer;
-		var->size = size;
-		if (state.variables.head == NULL) {
-			state.variables.head = var;
-		} else {
-			state.variables.tail->next = var;
-		}
-		state.variables.tail = var;
-		// get mmPage's corresponding to variable
-		// get start page address
-		size_t pageAddress = ((size_t)pointer&(~0xfff));
-		size_t pageIndex = (pageAddress - (size_t)state.reactiveMem->imPointer)/4096;
-		// get last page address
-		size_t variableLastPageAddress = ((size_t)pointer + size)&(~0xfff);
-		size_t variablePagesCount = 1 + (variableLastPageAddress - pageAddress)/4096;
-		size_t i;
-		for (i=0; i<variablePagesCount; i++) {
-			// one variable can be linked with multiple pages
-			variableEntry* dependentEntry = memAlloc(sizeof(variableEntry));
-			if (dependentEntry != NULL) {
-				dependentEntry->variable = var;
-				dependentEntry->prev = NULL;
-				dependentEntry->next = NULL;
-				if (state.reactiveMem->pages[pageIndex+i].dependents.head == NULL) {
-					state.reactiveMem->pages[pageIndex+i].dependents.head = dependentEntry;
-					state.reactiveMem->pages[pageIndex+i].dependents.tail = dependentEntry;
-				} else {
-					dependentEntry->prev = state.reactiveMem->pages[pageIndex].dependents.tail;
-					state.reactiveMem->pages[pageIndex+i].dependents.tail->next = dependentEntry;
-					state.reactiveMem->pages[pageIndex+i].dependents.tail = dependentEntry;
+// size must not be 0
+size_t getPagesCount(void* pointer, size_t size) {
+	// get start page address
+	size_t pageAddress = ((size_t)pointer&(~0xfff));
+	// get last page address
+	size_t variableLastPageAddress = ((size_t)pointer + size - 1)&(~0xfff);
+	return 1 + (variableLastPageAddress - pageAddress)/4096;
+}
+
+// variable must be inside reactive memory, instrumented and trapped variables can't share pages
+bool isPlacementAllowed(void* pointer, size_t size, bool isInstrumented) {
+	mmBlock* block = state.reactiveMem;
+	bool result = block != NULL && ((size_t)block->imPointer <= (size_t)pointer) && ((size_t)pointer+size <= (size_t)block->imPointer+block->size);
+	if (result) {
+		size_t pageIndex = (((size_t)pointer&(~0xfff)) - (size_t)block->imPointer)/4096;
+		size_t variablePagesCount = getPagesCount(pointer, size);
+		for (size_t i=0; i<variablePagesCount && result; i++) {
+			mmPage* page = &block->pages[pageIndex+i];
+			if (isInstrumented) {
+				// page with trapped variables must stay guarded
+				variableEntry* entry = page->dependents.head;
+				while (entry!=NULL && result) {
+					result = entry->variable->handle != NULL;
+					entry = entry->next;
 				}
 			} else {
-				allDependentsAllocationSuccess = false;
-				break;
+				// page with instrumented variables is not guarded, writes to trapped variable would be missed
+				result = page->instrumentedCount == 0;
 			}
 		}
-		if (!allDependentsAllocationSuccess) {
-			// clean up and free previously added dependents
-			for (i=0; i<variablePagesCount; i++) {
-				variableEntry* nextVariableEntry;
-				nextVariableEntry = state.reactiveMem->pages[pageIndex+i].dependents.head;
-				while (nextVariableEntry!=NULL) {
-					if (nextVariableEntry->variable == var) {
-						if (nextVariableEntry->prev!=NULL) {
-							nextVariableEntry->prev->next = nextVariableEntry->next;
-							if (nextVariableEntry->next==NULL) { // this is last element
-								state.reactiveMem->pages[pageIndex+i].dependents.tail = nextVariableEntry->prev;
-							}
-						} else { // this is first element
-							if (nextVariableEntry->next!=NULL) {
-								state.reactiveMem->pages[pageIndex+i].dependents.head = nextVariableEntry->next;
-							} else { // only one element
-								state.reactiveMem->pages[pageIndex+i].dependents.head = NULL;
-								state.reactiveMem->pages[pageIndex+i].dependents.tail = NULL;
-							}
-						}
-						if (nextVariableEntry->next!=NULL) {
-							nextVariableEntry->next->prev = nextVariableEntry->prev;
-						}
-						memFree(nextVariableEntry);
-						break;
-					}
-					nextVariableEntry = nextVariableEntry->next;
-				}
+	}
+	return result;
+}
+
+// variable must have page entries for all its pages
+void initVariable(variable* var, void* pointer, size_t size) {
+	// get mmPage's corresponding to variable
+	size_t pageAddress = ((size_t)pointer&(~0xfff));
+	size_t pageIndex = (pageAddress - (size_t)state.reactiveMem->imPointer)/4096;
+	size_t variablePagesCount = getPagesCount(pointer, size);
+	var->id = state.nextVariableId++;
+	var->isComputed = false;
+	var->callback = NULL;
+	var->triggerCallback = NULL;
+	var->contextCallback = NULL;
+	var->contextTriggerCallback = NULL;
+	var->callbackContext = NULL;
+	var->triggerContext = NULL;
+	var->observers.head = NULL;
+	var->observers.tail = NULL;
+	var->depends.head = NULL;
+	var->depends.tail = NULL;
+	size_t offset = (size_t)pointer - (size_t)state.reactiveMem->imPointer; // delta
+	var->bufValue = (void*)((size_t)state.reactiveMem->reBufPointer+offset);
+	var->oldValue = (void*)((size_t)state.reactiveMem->reOldPointer+offset);
+	var->value = pointer;
+	var->size = size;
+	var->pageIndex = pageIndex;
+	var->pagesCount = variablePagesCount;
+	var->prev = state.variables.tail;
+	var->next = NULL;
+	if (state.variables.head == NULL) {
+		state.variables.head = var;
+	} else {
+		state.variables.tail->next = var;
+	}
+	state.variables.tail = var;
+	var->handle = NULL;
+	var->delivery = RM_DELIVERY_IMMEDIATE;
+	var->interval = 0;
+	var->pendingOldValue = NULL;
+	var->isScheduled = false;
+	var->timerEntry.variable = var;
+	var->timerEntry.link = NULL;
+	for (size_t i=0; i<variablePagesCount; i++) {
+		var->pageEntries[i].variable = var;
+		var->pageEntries[i].link = NULL;
+		appendEntry(&state.reactiveMem->pages[pageIndex+i].dependents, &var->pageEntries[i]);
+		updatePageGuard(pageIndex+i); // page released by removal of its last variable is guarded again
+	}
+	if (state.tracking == RM_TRACKING_POLLING) {
+		// snapshot for compare on flush
+		memCopy(var->oldValue, var->value, var->size);
+	}
+}
+
+// returns NULL if error occured
+variable* createVariable(void* pointer, size_t size, bool isInstrumented) {
+	size_t variablePagesCount = 0;
+	variable* var = NULL;
+	if (size > 0 && isPlacementAllowed(pointer, size, isInstrumented)) { // variable without bytes has no pages
+		variablePagesCount = getPagesCount(pointer, size);
+		var = state.freeVariables;
+		if (var != NULL) {
+			state.freeVariables = var->next;
+		} else {
+			var = memAlloc(sizeof(variable));
+			if (var != NULL) {
+				var->pageEntries = NULL;
+				var->pageEntriesCapacity = 0;
+				var->isChunkVariable = false;
+				var->isChunkPageEntries = false;
 			}
 		}
-		if (!allDependentsAllocationSuccess) {
-			// remove previously created variable
-			if (state.variables.head == state.variables.tail) { // only one element
-				state.variables.head = NULL;
-				state.variables.tail = NULL;
-			} else {
-				oldTail->next = NULL; // oldTail can't be NULL here
-				state.variables.tail = oldTail;
-			}
-			memFree(var);
+	}
+	if (var != NULL && var->pageEntriesCapacity < variablePagesCount) {
+		// one variable can be linked with multiple pages
+		variableEntry* pageEntries;
+		if (var->isChunkPageEntries) {
+			pageEntries = memAlloc(variablePagesCount*sizeof(variableEntry));
+		} else {
+			pageEntries = memRealloc(var->pageEntries, variablePagesCount*sizeof(variableEntry));
+		}
+		if (pageEntries != NULL) {
+			var->pageEntries = pageEntries;
+			var->pageEntriesCapacity = variablePagesCount;
+			var->isChunkPageEntries = false;
+		} else {
+			var->next = state.freeVariables;
+			state.freeVariables = var;
 			var = NULL;
 		}
 	}
+	if (var != NULL) {
+		initVariable(var, pointer, size);
+	}
 	return var;
 }
 
+// unlink variable from all indices and edge lists and keep it for reuse, O(degree)
+void removeVariable(variable* var) {
+	variableEntry* entry;
+	variableEntry* nextEntry;
+	// computed variables which depends on this variable
+	nextEntry = var->observers.head;
+	while (nextEntry!=NULL) {
+		entry = nextEntry;
+		nextEntry = nextEntry->next;
+		removeEntry(&entry->variable->depends, entry->link);
+		releaseVariableEntry(entry->link);
+		releaseVariableEntry(entry);
+	}
+	var->observers.head = NULL;
+	var->observers.tail = NULL;
+	// variables on which this computed variable depends
+	nextEntry = var->depends.head;
+	while (nextEntry!=NULL) {
+		entry = nextEntry;
+		nextEntry = nextEntry->next;
+		removeEntry(&entry->variable->observers, entry->link);
+		releaseVariableEntry(entry->link);
+		releaseVariableEntry(entry);
+	}
+	var->depends.head = NULL;
+	var->depends.tail = NULL;
+	bool isInstrumented = var->handle != NULL;
+	if (isInstrumented) {
+		if (var->handle->isPending) {
+			// drop enqueued change
+			size_t j = 0;
+			for (size_t i=0; i<state.changedVariablesCount; i++) {
+				if (state.changedVariables[i] != var) {
+					state.changedVariables[j++] = state.changedVariables[i];
+				}
+			}
+			state.changedVariablesCount = j;
+			state.changedVariables[j] = NULL;
+		}
+		memFree(var->handle);
+		var->handle = NULL;
+	}
+	unscheduleTrigger(var);
+	memFree(var->pendingOldValue);
+	var->pendingOldValue = NULL;
+	for (size_t i=0; i<var->pagesCount; i++) {
+		mmPage* page = &state.reactiveMem->pages[var->pageIndex+i];
+		removeEntry(&page->dependents, &var->pageEntries[i]);
+		if (isInstrumented) {
+			page->instrumentedCount--;
+		}
+		updatePageGuard(var->pageIndex+i); // no reactive variables left on page, accesses to it must not raise exceptions
+	}
+	if (var->prev != NULL) {
+		var->prev->next = var->next;
+	} else {
+		state.variables.head = var->next;
+	}
+	if (var->next != NULL) {
+		var->next->prev = var->prev;
+	} else {
+		state.variables.tail = var->prev;
+	}
+	var->triggerCallback = NULL;
+	var->contextTriggerCallback = NULL;
+	var->next = state.freeVariables;
+	state.freeVariables = var;
+}
+
+variable* findVariable(void* pointer) {
+	variable* result = NULL;
+	if (state.reactiveMem != NULL && ((size_t)state.reactiveMem->imPointer <= (size_t)pointer) && ((size_t)pointer < (size_t)state.reactiveMem->imPointer+state.reactiveMem->size)) {
+		result = getVariableFromPage(pointer);
+	}
+	return result;
+}
+
 RM_STATUS ref(void* pointer, size_t size) {
 	RM_STATUS result = RM_STATUS_SUCCESS;
-	variable* var = createVariable(pointer, size);
+	variable* var = createVariable(pointer, size, false);
 	if (var == NULL) {
 		result = RM_STATUS_FAIL;
 	}
 	return result;
 }
 
-RM_STATUS computed(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer)) {
+// returns NULL if error occured
+instrumentedRef* refInstrumented(void* pointer, size_t size) {
+	instrumentedRef* handle = memAlloc(sizeof(instrumentedRef));
+	variable* var = NULL;
+	if (handle != NULL) {
+		var = createVariable(pointer, size, true);
+	}
+	if (var == NULL) {
+		memFree(handle);
+		handle = NULL;
+	} else {
+		handle->value = pointer;
+		handle->isPending = false;
+		handle->variable = var;
+		var->handle = handle;
+		for (size_t i=0; i<var->pagesCount; i++) {
+			state.reactiveMem->pages[var->pageIndex+i].instrumentedCount++;
+			updatePageGuard(var->pageIndex+i); // accessed without exceptions
+		}
+	}
+	return handle;
+}
+
+void instrumentedLoad(instrumentedRef* handle) {
+	if (state.registerComputed != NULL) {
+		recordDepends((variable*)handle->variable);
+	}
+}
+
+void instrumentedStore(instrumentedRef* handle) {
+	variable* var = (variable*)handle->variable;
+	// save old value for ref variable
+	memCopy(var->oldValue, var->value, var->size);
+	handle->isPending = true;
+	enqueueChange(var);
+}
+
+// discovery of depends for new computed variables, NULL elements are skipped
+void enumerateComputedDepends(variable** computeds, size_t count) {
+	if (state.tracking == RM_TRACKING_POLLING) {
+		lockReactivePages(); // pages guarded only while depends are enumerated
+	}
+	for (size_t i=0; i<count; i++) {
+		if (computeds[i] != NULL) {
+			enumerateDepends(computeds[i]);
+		}
+	}
+	if (state.tracking == RM_TRACKING_POLLING) {
+		state.pagesProtectUnlock(state.reactiveMem->imPointer, state.reactiveMem->size);
+		for (size_t i=0; i<count; i++) {
+			if (computeds[i] != NULL) {
+				memCopy(computeds[i]->value, computeds[i]->bufValue, computeds[i]->size); // no lazy calculation on read without guard
+			}
+		}
+	}
+}
+
+RM_STATUS createComputed(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer), void (*contextCallback)(void* bufForReturnValue, void* imPointer, void* context), void* context) {
 	RM_STATUS result = RM_STATUS_SUCCESS;
-	variable* var = createVariable(pointer, size);
+	variable* var = NULL;
+	if (callback != NULL || contextCallback != NULL) {
+		var = createVariable(pointer, size, false);
+	}
 	if (var == NULL) {
 		result = RM_STATUS_FAIL;
 	} else {
 		var->isComputed = true;
 		var->callback = callback;
-		state.registerComputed = var;
-		var->callback(var->bufValue, state.reactiveMem->imPointer); // call computed callback for #PF and enum depends for computed and observers for refs in #PF handler routine
-		state.registerComputed = NULL;
+		var->contextCallback = contextCallback;
+		var->callbackContext = context;
+		enumerateComputedDepends(&var, 1);
+	}
+	return result;
+}
+
+RM_STATUS computed(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer)) {
+	return createComputed(pointer, size, callback, NULL, NULL);
+}
+
+RM_STATUS computedWithContext(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer, void* context), void* context) {
+	return createComputed(pointer, size, NULL, callback, context);
+}
+
+RM_STATUS watch(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer)) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* variable = findVariable(pointer);
+	if (variable == NULL) {
+		result = RM_STATUS_FAIL;
+	} else {
+		variable->triggerCallback = triggerCallback;
+		variable->contextTriggerCallback = NULL;
+	}
+	return result;
+}
+
+RM_STATUS watchWithContext(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer, void* context), void* context) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* variable = findVariable(pointer);
+	if (variable == NULL) {
+		result = RM_STATUS_FAIL;
+	} else {
+		variable->triggerCallback = NULL;
+		variable->contextTriggerCallback = triggerCallback;
+		variable->triggerContext = context;
+	}
+	return result;
+}
+
+int compareDescriptors(const void* first, const void* second) {
+	size_t firstPointer = (size_t)(*(const variableDescriptor**)first)->pointer;
+	size_t secondPointer = (size_t)(*(const variableDescriptor**)second)->pointer;
+	return (firstPointer > secondPointer) - (firstPointer < secondPointer);
+}
+
+// all variables are registered or none of them
+RM_STATUS registerMany(const variableDescriptor* descriptors, size_t count) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	const variableDescriptor** sorted = memAlloc(count*sizeof(variableDescriptor*));
+	variable** computeds = memAlloc(count*sizeof(variable*)); // computed variables in registration order
+	size_t totalPagesCount = 0;
+	bool isValid = true;
+	for (size_t i=0; i<count && isValid; i++) {
+		const variableDescriptor* descriptor = &descriptors[i];
+		// variable without bytes and computed variable without callback can't be registered
+		isValid = descriptor->size > 0 && (descriptor->kind != RM_VARIABLE_COMPUTED || descriptor->callback != NULL) && isPlacementAllowed(descriptor->pointer, descriptor->size, false);
+		if (isValid) {
+			totalPagesCount += getPagesCount(descriptor->pointer, descriptor->size);
+		}
+	}
+	// one allocation for all variables and their page entries
+	variableChunk* chunk = memAlloc(sizeof(variableChunk)+count*sizeof(variable)+totalPagesCount*sizeof(variableEntry));
+	if (count == 0) {
+		memFree(sorted);
+		memFree(computeds);
+		memFree(chunk);
+	} else if (!isValid || sorted == NULL || computeds == NULL || chunk == NULL) {
+		memFree(sorted);
+		memFree(computeds);
+		memFree(chunk);
+		result = RM_STATUS_FAIL;
+	} else {
+		chunk->next = state.chunks;
+		state.chunks = chunk;
+		variable* variables = (variable*)(void*)(chunk+1);
+		variableEntry* pageEntries = (variableEntry*)(void*)(variables+count);
+		// variables and page dependents lists are built in address order
+		for (size_t i=0; i<count; i++) {
+			sorted[i] = &descriptors[i];
+		}
+		qsort((void*)sorted, count, sizeof(variableDescriptor*), compareDescriptors);
+		for (size_t i=0; i<count; i++) {
+			const variableDescriptor* descriptor = sorted[i];
+			variable* var = &variables[i];
+			var->pageEntries = pageEntries;
+			var->pageEntriesCapacity = getPagesCount(descriptor->pointer, descriptor->size);
+			var->isChunkVariable = true;
+			var->isChunkPageEntries = true;
+			pageEntries += var->pageEntriesCapacity;
+			initVariable(var, descriptor->pointer, descriptor->size);
+			var->triggerCallback = descriptor->triggerCallback;
+			if (descriptor->kind == RM_VARIABLE_COMPUTED) {
+				var->isComputed = true;
+				var->callback = descriptor->callback;
+				computeds[descriptor-descriptors] = var;
+			} else {
+				computeds[descriptor-descriptors] = NULL;
+			}
+		}
+		// dependencies discovery in one pass after all variables are linked, in descriptor order
+		// as for computed(), only ref variables become depends, computed variables read by callback are not tracked
+		enumerateComputedDepends(computeds, count);
+		memFree(sorted);
+		memFree(computeds);
+	}
+	return result;
+}
+
+RM_STATUS unref(void* pointer) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* var = findVariable(pointer);
+	if (var == NULL || var->isComputed) {
+		result = RM_STATUS_FAIL;
+	} else {
+		removeVariable(var);
+	}
+	return result;
+}
+
+RM_STATUS uncomputed(void* pointer) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* var = findVariable(pointer);
+	if (var == NULL || !var->isComputed) {
+		result = RM_STATUS_FAIL;
+	} else {
+		removeVariable(var);
+	}
+	return result;
+}
+
+void unwatch(void* pointer) {
+	variable* variable = findVariable(pointer);
+	if (variable != NULL) {
+		unscheduleTrigger(variable); // pending changes are dropped
+		variable->triggerCallback = NULL;
+		variable->contextTriggerCallback = NULL;
+	}
+}
+
+// removes trigger only if it is still installed with this context, trigger installed later by another watcher stays
+void unwatchWithContext(void* pointer, void* context) {
+	variable* variable = findVariable(pointer);
+	if (variable != NULL && variable->contextTriggerCallback != NULL && variable->triggerContext == context) {
+		unscheduleTrigger(variable); // pending changes are dropped
+		variable->contextTriggerCallback = NULL;
+	}
+}
+
+// interval in milliseconds of tick time, not used for RM_DELIVERY_IMMEDIATE and RM_DELIVERY_ON_FLUSH
+RM_STATUS watchDelivery(void* pointer, RM_DELIVERY delivery, uint64_t interval) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* var = findVariable(pointer);
+	if (var == NULL) {
+		result = RM_STATUS_FAIL;
+	} else {
+		if (delivery != RM_DELIVERY_IMMEDIATE && var->pendingOldValue == NULL) {
+			var->pendingOldValue = memAlloc(var->size);
+		}
+		if (delivery != RM_DELIVERY_IMMEDIATE && var->pendingOldValue == NULL) {
+			result = RM_STATUS_FAIL;
+		} else {
+			unscheduleTrigger(var); // pending changes are dropped
+			if ((delivery == RM_DELIVERY_DEBOUNCE || delivery == RM_DELIVERY_THROTTLE) && interval == 0) {
+				delivery = RM_DELIVERY_IMMEDIATE;
+			}
+			var->delivery = delivery;
+			var->interval = interval;
+			var->nextDelivery = 0;
+		}
+	}
+	return result;
+}
+
+// advance timer wheel to now (milliseconds of monotonic clock) and deliver due triggers
+void tick(uint64_t now) {
+	uint64_t steps = 0;
+	if (now > state.wheelTime) {
+		steps = now-state.wheelTime;
+	}
+	if (steps > RM_WHEEL_SLOTS) { // every slot visited once
+		steps = RM_WHEEL_SLOTS;
+	}
+	state.now = now;
+	for (uint64_t i=1; i<=steps; i++) {
+		variableEntry* entry = state.wheel[(state.wheelTime+i)%RM_WHEEL_SLOTS].head;
+		while (entry!=NULL) {
+			variable* var = entry->variable;
+			entry = entry->next; // trigger can schedule variables into this slot again
+			if (var->deadline <= now) {
+				unscheduleTrigger(var);
+				if (var->delivery == RM_DELIVERY_THROTTLE) {
+					var->nextDelivery = now+var->interval;
+				}
+				callTrigger(var, var->pendingOldValue);
+			}
+		}
+	}
+	if (now > state.wheelTime) {
+		state.wheelTime = now;
+	}
+}
+
+// changes of ref variables made before switch from RM_TRACKING_POLLING must be flushed
+RM_STATUS setWriteTracking(RM_TRACKING tracking, void (*pagesCollectDirty)(void* pointer, size_t pagesCount, bool* dirtyPages)) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	mmBlock* block = state.reactiveMem;
+	if (block == NULL) { // reactiveAlloc not called yet
+		result = RM_STATUS_FAIL;
+	} else if (tracking == RM_TRACKING_POLLING) {
+		if (block->dirtyPages == NULL) {
+			block->dirtyPages = memAlloc(sizeof(bool)*block->pagesCount);
+		}
+		if (block->dirtyPages == NULL || pagesCollectDirty == NULL) {
+			result = RM_STATUS_FAIL;
+		} else {
+			state.pagesProtectUnlock(block->imPointer, block->size);
+			// snapshot of ref variables for compare on flush, instrumented variables keep old value of pending RM_STORE
+			variable* var = state.variables.head;
+			while (var!=NULL) {
+				if (!var->isComputed && var->handle == NULL) {
+					memCopy(var->oldValue, var->value, var->size);
+				}
+				var = var->next;
+			}
+			pagesCollectDirty(block->imPointer, block->pagesCount, block->dirtyPages); // reset dirty state
+			state.pagesCollectDirty = pagesCollectDirty;
+			state.tracking = RM_TRACKING_POLLING;
+		}
+	} else {
+		state.pagesCollectDirty = NULL;
+		state.tracking = RM_TRACKING_EXCEPTIONS;
+		lockReactivePages();
+	}
+	return result;
+}
+
+// propagate changes enqueued by RM_STORE
+// for RM_TRACKING_POLLING also compare ref variables on written pages with snapshot
+void flush() {
+	mmBlock* block = state.reactiveMem;
+	if (state.tracking == RM_TRACKING_POLLING) {
+		state.pagesCollectDirty(block->imPointer, block->pagesCount, block->dirtyPages);
+		for (size_t i=0; i<block->pagesCount; i++) {
+			if (block->dirtyPages[i]) {
+				variableEntry* entry = block->pages[i].dependents.head;
+				while (entry!=NULL) {
+					variable* var = entry->variable;
+					// variable placed on few dirty pages is compared only on first dirty of them
+					bool isFirstDirty = true;
+					for (size_t j=var->pageIndex; j<i && isFirstDirty; j++) {
+						isFirstDirty = !block->dirtyPages[j];
+					}
+					if (!var->isComputed && var->handle == NULL && isFirstDirty) {
+						if (memCompare(var->value, var->oldValue, var->size) != 0) {
+							enqueueChange(var);
+						}
+					}
+					entry = entry->next;
+				}
+			}
+		}
+	}
+	while (state.changedVariablesCount>0) { // changes enqueued by triggers (RM_STORE) are propagated by same flush
+		if (state.tracking == RM_TRACKING_POLLING) {
+			lockReactivePages(); // callbacks of computed variables enumerate depends by #PF
+		}
+		propagateChanges();
+		if (state.tracking == RM_TRACKING_POLLING) {
+			state.pagesProtectUnlock(block->imPointer, block->size);
+		}
+	}
+	while (state.flushTriggers.head != NULL) {
+		variable* var = state.flushTriggers.head->variable;
+		unscheduleTrigger(var);
+		callTrigger(var, var->pendingOldValue);
+	}
+}
+
+// id of registered variable, same as variableId of its change log records
+RM_STATUS variableId(void* pointer, uint32_t* id) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	variable* var = findVariable(pointer);
+	if (var == NULL) {
+		result = RM_STATUS_FAIL;
+	} else {
+		*id = var->id;
+	}
+	return result;
+}
+
+// memory can be shared with consumer processes, they read it by changeLogNext/changeLogRelease
+RM_STATUS attachChangeLog(void* memPointer, size_t memSize, RM_CHANGELOG_OVERFLOW overflow) {
+	RM_STATUS result = RM_STATUS_SUCCESS;
+	if (memSize < sizeof(changeLog)+64) {
+		result = RM_STATUS_FAIL;
+	} else {
+		changeLog* log = (changeLog*)memPointer;
+		uint64_t capacity = 64; // power of two for ring position mask
+		while (capacity*2 <= memSize-sizeof(changeLog)) {
+			capacity *= 2;
+		}
+		storeShared64(&log->head, 0);
+		storeShared64(&log->tail, 0);
+		log->capacity = capacity;
+		storeShared64(&log->overflowCount, 0);
+		state.logOverflow = overflow;
+		state.logPosition = 0;
+		state.logSequence = 0;
+		state.logBatchDropped = false;
+		state.log = log;
 	}
 	return result;
 }
 
-void watch(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer)) {
-	variable* variable = getVariable(pointer);
-	variable->triggerCallback = triggerCallback;
+void detachChangeLog() {
+	state.log = NULL;
 }
 
 // returns NULL if error occured
@@ -425,7 +1196,11 @@ void* reactiveAlloc(size_t memSize) {
 	for (size_t i=0; i<block->pagesCount; i++) {
 		block->pages[i].dependents.head = NULL;
 		block->pages[i].dependents.tail = NULL;
+		block->pages[i].instrumentedCount = 0;
+		block->pages[i].isPlain = false;
 	}
+	block->plainPagesCount = 0;
+	block->dirtyPages = NULL;
 	block->size = memSize;
 	#ifdef THREADSAFE
 		mtx_init(&block->mutex, mtx_plain|mtx_recursive); // TODO handle errors
@@ -442,22 +1217,17 @@ void reactiveFree(void* memPointer) {
 	state.pagesFree(state.reactiveMem->reBufPointer);
 	state.pagesFree(memPointer);
 	for (size_t i=0; i<state.reactiveMem->pagesCount; i++) {
-		// free dependents list
-		variableEntry* variableEntryToFree;
-		variableEntry* nextVariableEntry;
-		variableEntryToFree = NULL;
-		nextVariableEntry = state.reactiveMem->pages[i].dependents.head;
-		while (nextVariableEntry!=NULL) {
-			variableEntryToFree = nextVariableEntry;
-			nextVariableEntry = nextVariableEntry->next;
-			memFree(variableEntryToFree);
-		}
+		// dependents entries owned by variables and freed with them
 		state.reactiveMem->pages[i].dependents.head = NULL;
 		state.reactiveMem->pages[i].dependents.tail = NULL;
 	}
 	memFree(state.reactiveMem->pages); // free pages descriptors
+	memFree(state.reactiveMem->dirtyPages);
 	memFree(state.reactiveMem);
 	state.reactiveMem = NULL;
+	// next reactive memory starts with guarded pages
+	state.pagesCollectDirty = NULL;
+	state.tracking = RM_TRACKING_EXCEPTIONS;
 }
 
 RM_STATUS initReactivity(RM_MODE mode, void* (*pagesAlloc)(size_t size, bool isGuard), void (*pagesFree)(void* pointer), void (*pagesProtectLock)(void* pointer, size_t size), void (*pagesProtectUnlock)(void* pointer, size_t size), void (*enableTrap)(void* userData)) {
@@ -508,14 +1278,60 @@ void freeReactivity() {
 		}
 		variableToFree->depends.head = NULL;
 		variableToFree->depends.tail = NULL;
-		memFree(variableToFree);
+		memFree(variableToFree->handle);
+		memFree(variableToFree->pendingOldValue);
+		if (!variableToFree->isChunkPageEntries) {
+			memFree(variableToFree->pageEntries);
+		}
+		if (!variableToFree->isChunkVariable) {
+			memFree(variableToFree);
+		}
 	}
 	state.variables.head = NULL;
 	state.variables.tail = NULL;
+	// free removed variables and entries kept for reuse
+	nextVariable = state.freeVariables;
+	while (nextVariable!=NULL) {
+		variableToFree = nextVariable;
+		nextVariable = nextVariable->next;
+		if (!variableToFree->isChunkPageEntries) {
+			memFree(variableToFree->pageEntries);
+		}
+		if (!variableToFree->isChunkVariable) {
+			memFree(variableToFree);
+		}
+	}
+	state.freeVariables = NULL;
+	variableChunk* chunkToFree = NULL;
+	variableChunk* nextChunk = state.chunks;
+	while (nextChunk!=NULL) {
+		chunkToFree = nextChunk;
+		nextChunk = nextChunk->next;
+		memFree(chunkToFree);
+	}
+	state.chunks = NULL;
+	variableEntry* entryToFree = NULL;
+	variableEntry* nextEntry = state.freeEntries;
+	while (nextEntry!=NULL) {
+		entryToFree = nextEntry;
+		nextEntry = nextEntry->next;
+		memFree(entryToFree);
+	}
+	state.freeEntries = NULL;
 	memFree(state.changedVariables);
 	state.pagesAlloc = NULL;
 	state.pagesFree = NULL;
 	state.pagesProtectLock = NULL;
 	state.pagesProtectUnlock = NULL;
 	state.enableTrap = NULL;
+	state.pagesCollectDirty = NULL;
+	state.tracking = RM_TRACKING_EXCEPTIONS;
+	for (size_t i=0; i<RM_WHEEL_SLOTS; i++) {
+		state.wheel[i].head = NULL;
+		state.wheel[i].tail = NULL;
+	}
+	state.flushTriggers.head = NULL;
+	state.flushTriggers.tail = NULL;
+	state.now = 0;
+	state.wheelTime = 0;
 }
\ No newline at end of file
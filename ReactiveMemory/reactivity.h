@@ -5,6 +5,7 @@
 #define memRealloc realloc
 #define memFree free
 #define memCopy memcpy
+#define memCompare memcmp
 // #define THREADSAFE
 
 #include <stdbool.h>
@@ -16,6 +17,42 @@
 	#include <threads.h>
 #endif
 
+// x86/x64 keeps order of stores and order of loads, so change log needs only compiler barrier
+#ifdef _MSC_VER
+	#include <intrin.h>
+	#define RM_BARRIER() _ReadWriteBarrier()
+#else
+	#define RM_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+// head and tail of change log are 64-bit and shared between processes, on x86 plain access to them can be torn
+#if defined(_MSC_VER) && defined(_M_IX86)
+	static inline uint64_t loadShared64(volatile uint64_t* pointer) {
+		return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)pointer, 0, 0);
+	}
+	static inline void storeShared64(volatile uint64_t* pointer, uint64_t value) {
+		__int64 oldValue = *(volatile __int64*)pointer;
+		__int64 currentValue;
+		while ((currentValue = _InterlockedCompareExchange64((volatile __int64*)pointer, (__int64)value, oldValue)) != oldValue) {
+			oldValue = currentValue;
+		}
+	}
+#elif defined(_MSC_VER)
+	static inline uint64_t loadShared64(volatile uint64_t* pointer) {
+		return *pointer;
+	}
+	static inline void storeShared64(volatile uint64_t* pointer, uint64_t value) {
+		*pointer = value;
+	}
+#else
+	static inline uint64_t loadShared64(volatile uint64_t* pointer) {
+		return __atomic_load_n(pointer, __ATOMIC_RELAXED);
+	}
+	static inline void storeShared64(volatile uint64_t* pointer, uint64_t value) {
+		__atomic_store_n(pointer, value, __ATOMIC_RELAXED);
+	}
+#endif
+
 // TODO memory manager
 // TODO RM_MODE_NONLAZY
 
@@ -32,6 +69,37 @@ typedef enum RM_MODE {
 	RM_MODE_NONLAZY = 1
 } RM_MODE;
 
+// RM_TRACKING_EXCEPTIONS
+//  reactive pages are guarded, every write raises exception and changes propagate after write instruction
+// RM_TRACKING_POLLING
+//  reactive pages are not guarded, writes are plain stores and changes propagate on flush
+//  pagesCollectDirty must mark pages written since previous call and reset their dirty state, for example:
+//   linux: soft-dirty bit 55 of /proc/self/pagemap entries, then write "4" to /proc/self/clear_refs (or userfaultfd async write-protect)
+//   windows: GetWriteWatch with WRITE_WATCH_FLAG_RESET for pages allocated with MEM_WRITE_WATCH
+//  pages are still guarded while computed callbacks run, for enumeration of depends
+
+typedef enum RM_TRACKING {
+	RM_TRACKING_EXCEPTIONS = 0,
+	RM_TRACKING_POLLING = 1
+} RM_TRACKING;
+
+// RM_DELIVERY_IMMEDIATE
+//  trigger is called on every change
+// RM_DELIVERY_DEBOUNCE
+//  trigger is called when variable was not changed for interval
+// RM_DELIVERY_THROTTLE
+//  trigger is called at most once per interval, first change immediately and rest at end of interval
+// RM_DELIVERY_ON_FLUSH
+//  trigger is called on flush
+// delayed triggers get old value of first change and current value, time comes from tick
+
+typedef enum RM_DELIVERY {
+	RM_DELIVERY_IMMEDIATE = 0,
+	RM_DELIVERY_DEBOUNCE = 1,
+	RM_DELIVERY_THROTTLE = 2,
+	RM_DELIVERY_ON_FLUSH = 3
+} RM_DELIVERY;
+
 typedef enum RM_EXCEPTION {
 	RM_EXCEPTION_PAGEFAULT = 0,
 	RM_EXCEPTION_DEBUG = 1
@@ -42,13 +110,153 @@ typedef enum RM_STATUS {
 	RM_STATUS_FAIL = 1
 } RM_STATUS;
 
+typedef enum RM_VARIABLE {
+	RM_VARIABLE_REF = 0,
+	RM_VARIABLE_COMPUTED = 1
+} RM_VARIABLE;
+
+typedef struct variableDescriptor {
+	void* pointer;
+	size_t size;
+	RM_VARIABLE kind;
+	void (*callback)(void* bufForReturnValue, void* imPointer); // only for RM_VARIABLE_COMPUTED
+	void (*triggerCallback)(void* value, void* oldValue, void* imPointer); // can be NULL
+} variableDescriptor;
+
+// RM_CHANGELOG_OVERFLOW_DROP
+//  drop whole batch if it not fits into free space of change log, increment overflowCount
+// RM_CHANGELOG_OVERFLOW_WAIT
+//  spin in propagation until consumer frees space, drop only batches bigger than change log
+
+typedef enum RM_CHANGELOG_OVERFLOW {
+	RM_CHANGELOG_OVERFLOW_DROP = 0,
+	RM_CHANGELOG_OVERFLOW_WAIT = 1
+} RM_CHANGELOG_OVERFLOW;
+
+typedef enum RM_CHANGELOG_RECORD {
+	RM_CHANGELOG_RECORD_CHANGE = 0, // length bytes of new value follows the record
+	RM_CHANGELOG_RECORD_COMMIT = 1, // end of batch, offset is batch sequence number
+	RM_CHANGELOG_RECORD_PADDING = 2 // skip length bytes up to end of ring
+} RM_CHANGELOG_RECORD;
+
+typedef struct changeLogRecord {
+	uint32_t type;
+	uint32_t variableId; // from variableId(), new for every registration of same address
+	uint64_t offset; // offset of changed bytes from start of reactive memory
+	uint64_t length;
+} changeLogRecord;
+
+// single-producer ring buffer, can be placed into memory shared with consumer processes
+// engine publishes head only after whole batch is written, so consumer always sees complete batches
+typedef struct changeLog {
+	volatile uint64_t head; // written by engine, accessed only by loadShared64/storeShared64
+	uint8_t headPadding[56];
+	volatile uint64_t tail; // written by consumer, accessed only by loadShared64/storeShared64
+	uint8_t tailPadding[56];
+	uint64_t capacity; // power of two
+	volatile uint64_t overflowCount; // count of dropped batches, accessed only by loadShared64/storeShared64
+} changeLog; // followed by capacity bytes of records
+
+// software-instrumented ref variables, pages with them are not guarded and can't hold trapped variables
+// (refInstrumented returns NULL for page with trapped variables, ref/computed/registerMany fail for page with instrumented variables)
+// RM_LOAD/RM_STORE do work of exceptionHandler as plain code:
+//  RM_LOAD records depends while computed callback enumerates them (computed callbacks must read instrumented variables by RM_LOAD)
+//  RM_STORE saves old value and enqueue change on first write since last propagation
+// enqueued changes propagate on flush or together with next trapped write
+// RM_LOAD(handle, uint64_t)
+// RM_STORE(handle, uint64_t, value)
+
+typedef struct instrumentedRef {
+	void* value;
+	bool isPending; // change enqueued and not propagated yet
+	void* variable;
+} instrumentedRef;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool dependsEnumeration;
+extern void instrumentedLoad(instrumentedRef* handle);
+extern void instrumentedStore(instrumentedRef* handle);
+
+static inline void* loadInstrumented(instrumentedRef* handle) {
+	if (dependsEnumeration) {
+		instrumentedLoad(handle);
+	}
+	return handle->value;
+}
+
+static inline void* storeInstrumented(instrumentedRef* handle) {
+	if (!handle->isPending) {
+		instrumentedStore(handle);
+	}
+	return handle->value;
+}
+
+#define RM_LOAD(handle, type) (*(type*)loadInstrumented(handle))
+#define RM_STORE(handle, type, newValue) (*(type*)storeInstrumented(handle) = (newValue))
+
+// records are placed right after changeLog header, position is byte offset in ring
+static inline changeLogRecord* changeLogRecordAt(changeLog* log, uint64_t position) {
+	return (changeLogRecord*)(void*)((uint8_t*)(log+1)+position);
+}
+
+// consumer side, no engine state used
+
+// returns NULL if change log is empty
+static inline changeLogRecord* changeLogNext(changeLog* log) {
+	changeLogRecord* result = NULL;
+	uint64_t tail = loadShared64(&log->tail);
+	uint64_t head = loadShared64(&log->head);
+	while (result == NULL && tail != head) {
+		RM_BARRIER(); // read records only after head
+		uint64_t position = tail&(log->capacity-1);
+		changeLogRecord* record = changeLogRecordAt(log, position);
+		if (log->capacity-position < sizeof(changeLogRecord)) { // no place for record before end of ring
+			tail += log->capacity-position;
+		} else if (record->type == RM_CHANGELOG_RECORD_PADDING) {
+			tail += sizeof(changeLogRecord)+record->length;
+		} else {
+			result = record;
+		}
+	}
+	storeShared64(&log->tail, tail);
+	return result;
+}
+
+static inline void changeLogRelease(changeLog* log, changeLogRecord* record) {
+	RM_BARRIER(); // finish reading record before engine can overwrite it
+	storeShared64(&log->tail, loadShared64(&log->tail)+sizeof(changeLogRecord)+((record->length+7)&(~(uint64_t)7)));
+}
+
 extern RM_STATUS ref(void* pointer, size_t size);
+extern instrumentedRef* refInstrumented(void* pointer, size_t size);
 extern RM_STATUS computed(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer));
-extern void watch(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer));
+extern RM_STATUS computedWithContext(void* pointer, size_t size, void (*callback)(void* bufForReturnValue, void* imPointer, void* context), void* context);
+extern RM_STATUS watch(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer));
+extern RM_STATUS watchWithContext(void* pointer, void (*triggerCallback)(void* value, void* oldValue, void* imPointer, void* context), void* context);
+// unref/uncomputed/unwatch must not be called from compute or trigger callbacks
+extern RM_STATUS unref(void* pointer);
+extern RM_STATUS uncomputed(void* pointer);
+extern void unwatch(void* pointer);
+extern void unwatchWithContext(void* pointer, void* context);
+extern RM_STATUS watchDelivery(void* pointer, RM_DELIVERY delivery, uint64_t interval);
+extern void tick(uint64_t now);
+extern RM_STATUS registerMany(const variableDescriptor* descriptors, size_t count);
+extern RM_STATUS variableId(void* pointer, uint32_t* id);
+extern RM_STATUS attachChangeLog(void* memPointer, size_t memSize, RM_CHANGELOG_OVERFLOW overflow);
+extern void detachChangeLog();
+extern RM_STATUS setWriteTracking(RM_TRACKING tracking, void (*pagesCollectDirty)(void* pointer, size_t pagesCount, bool* dirtyPages));
+extern void flush();
 extern void* reactiveAlloc(size_t memSize);
 extern void reactiveFree(void* memPointer);
 extern RM_STATUS initReactivity(RM_MODE mode, void* (*pagesAlloc)(size_t size, bool isGuard), void (*pagesFree)(void* pointer), void (*pagesProtectLock)(void* pointer, size_t size), void (*pagesProtectUnlock)(void* pointer, size_t size), void (*enableTrap)(void* userData));
 extern void freeReactivity();
 extern void exceptionHandler(void* userData, RM_EXCEPTION exception, bool isWrite, void* pointer);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+#ifndef REACTIVITY_HPP
+#define REACTIVITY_HPP
+
+// typed C++ front end over reactivity.h, header only
+//  1. size of every variable is sizeof(T) and results of computed functions are assigned as T, so copies are fixed width
+//  2. lambdas (with captures too) are stored inside Computed/Watcher objects and passed to engine as context, no heap thunks
+//  3. engine keeps pointer to Computed/Watcher while registered, so they can't be copied or moved
+// usage:
+//  rm::Ref field1(&someStruct->field1);
+//  rm::Computed field3(&someStruct->field3, [someStruct]() { return someStruct->field1 + 2; });
+//  auto watcher = rm::watch(field3, [](const uint32_t& value, const uint32_t& oldValue) { ... });
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+	#error "reactivity.hpp requires C++17"
+#endif
+
+#include <type_traits>
+#include <utility>
+#include "reactivity.h"
+
+namespace rm {
+
+template<typename T>
+class Ref {
+	static_assert(std::is_trivially_copyable<T>::value, "reactive variable must be trivially copyable");
+public:
+	explicit Ref(T* pointer) : pointer(pointer), status(::ref(pointer, sizeof(T))) {}
+	~Ref() {
+		if (status == RM_STATUS_SUCCESS) {
+			::unref(pointer);
+		}
+	}
+	Ref(const Ref&) = delete;
+	Ref& operator=(const Ref&) = delete;
+	Ref& operator=(const T& value) {
+		*pointer = value;
+		return *this;
+	}
+	operator const T&() const {
+		return *pointer;
+	}
+	T* operator->() const {
+		return pointer;
+	}
+	T* get() const {
+		return pointer;
+	}
+	bool isRegistered() const {
+		return status == RM_STATUS_SUCCESS;
+	}
+private:
+	T* pointer;
+	RM_STATUS status;
+};
+
+template<typename T, typename F>
+class Computed {
+	static_assert(std::is_trivially_copyable<T>::value, "reactive variable must be trivially copyable");
+	static_assert(std::is_invocable_r<T, F&>::value, "computed function must return value convertible to T");
+public:
+	// function is called from engine for registration, so it must be stored before
+	Computed(T* pointer, F function) : pointer(pointer), function(std::move(function)) {
+		status = ::computedWithContext(pointer, sizeof(T), &compute, this);
+	}
+	~Computed() {
+		if (status == RM_STATUS_SUCCESS) {
+			::uncomputed(pointer);
+		}
+	}
+	Computed(const Computed&) = delete;
+	Computed& operator=(const Computed&) = delete;
+	operator const T&() const {
+		return *pointer;
+	}
+	const T* operator->() const {
+		return pointer;
+	}
+	T* get() const {
+		return pointer;
+	}
+	bool isRegistered() const {
+		return status == RM_STATUS_SUCCESS;
+	}
+private:
+	static void compute(void* bufForReturnValue, void* /*imPointer*/, void* context) {
+		Computed* self = static_cast<Computed*>(context);
+		*static_cast<T*>(bufForReturnValue) = self->function();
+	}
+	T* pointer;
+	F function;
+	RM_STATUS status;
+};
+
+template<typename T, typename F>
+Computed(T*, F) -> Computed<T, F>;
+
+template<typename T, typename F>
+class Watcher {
+	static_assert(std::is_invocable<F&, const T&, const T&>::value, "trigger function must accept (const T& value, const T& oldValue)");
+public:
+	Watcher(T* pointer, F function) : pointer(pointer), function(std::move(function)) {
+		status = ::watchWithContext(pointer, &trigger, this);
+	}
+	~Watcher() {
+		if (status == RM_STATUS_SUCCESS) {
+			::unwatchWithContext(pointer, this);
+		}
+	}
+	Watcher(const Watcher&) = delete;
+	Watcher& operator=(const Watcher&) = delete;
+	bool isRegistered() const {
+		return status == RM_STATUS_SUCCESS;
+	}
+private:
+	static void trigger(void* value, void* oldValue, void* /*imPointer*/, void* context) {
+		Watcher* self = static_cast<Watcher*>(context);
+		self->function(*static_cast<const T*>(value), *static_cast<const T*>(oldValue));
+	}
+	T* pointer;
+	F function;
+	RM_STATUS status;
+};
+
+// trigger is removed when returned watcher is destroyed
+template<typename T, typename F>
+[[nodiscard]] Watcher<T, F> watch(const Ref<T>& variable, F function) {
+	return Watcher<T, F>(variable.get(), std::move(function));
+}
+
+template<typename T, typename G, typename F>
+[[nodiscard]] Watcher<T, F> watch(const Computed<T, G>& variable, F function) {
+	return Watcher<T, F>(variable.get(), std::move(function));
+}
+
+}
+
+#endif